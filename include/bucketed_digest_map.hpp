@@ -0,0 +1,233 @@
+#ifndef KOKKOS_BUCKETED_DIGEST_MAP_HPP
+#define KOKKOS_BUCKETED_DIGEST_MAP_HPP
+#include <Kokkos_Core.hpp>
+#include <kokkos_murmur3.hpp>
+#include <map_helpers.hpp>
+#include <memory_accounting.hpp>
+#include <climits>
+
+/* Open addressing digest table with BucketSize slots per bucket.
+
+   Kokkos::UnorderedMap walks its bucket chains one entry at a time inside
+   insert()/find(), so its probing cannot be split across vector lanes. This
+   table lays slots out in fixed-size buckets and linear-probes bucket by
+   bucket, which gives two interchangeable probing strategies:
+     - flat: one thread scans the BucketSize slots of a bucket serially
+     - team: the BucketSize slots are scanned by the vector lanes of one
+       team thread (ThreadVectorRange), a single lane claims the free slot
+
+   Each slot has a state word, EMPTY -> BUSY -> FULL. An insert claims the
+   first EMPTY slot with a CAS, writes key and value, then publishes FULL.
+   Slots are never released, so an insert that sees a BUSY slot in a bucket
+   rescans it until the slot is published; two inserts of the same key can
+   therefore never both succeed.
+*/
+template<class Value, class ExecSpace = Kokkos::DefaultExecutionSpace, int BucketSize = 8>
+class BucketedDigestMap {
+  public:
+    using execution_space = ExecSpace;
+    using memory_space = typename ExecSpace::memory_space;
+    using key_type = HashDigest;
+    using value_type = Value;
+
+    static constexpr int bucket_size = BucketSize;
+    static constexpr uint32_t invalid_index = UINT_MAX;
+
+    enum : uint32_t { SLOT_EMPTY = 0, SLOT_BUSY = 1, SLOT_FULL = 2 };
+    enum InsertStatus { INSERT_SUCCESS = 0, INSERT_EXISTING = 1, INSERT_FAILED = 2 };
+
+    BucketedDigestMap(uint32_t capacity)
+      : m_num_buckets((capacity + BucketSize - 1) / BucketSize),
+        m_state("bucketed_state", m_num_buckets * BucketSize),
+        m_keys("bucketed_keys", m_num_buckets * BucketSize),
+        m_values("bucketed_values", m_num_buckets * BucketSize) {}
+
+    KOKKOS_INLINE_FUNCTION
+    uint32_t bucket_of(const HashDigest& digest) const {
+      return digest_hash()(digest) % m_num_buckets;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    InsertStatus insert(const HashDigest& digest, const Value& value) const {
+      uint32_t bucket = bucket_of(digest);
+      uint32_t probes = 0;
+      while(probes < m_num_buckets) {
+        uint32_t base = bucket * BucketSize;
+        int code = 3 * BucketSize;
+        for(int s = 0; s < BucketSize; ++s) {
+          int slot_code = classify_for_insert(base, s, digest);
+          code = slot_code < code ? slot_code : code;
+        }
+
+        if(code < BucketSize)
+          return INSERT_EXISTING;
+        if(code == BucketSize)
+          continue;
+        if(code < 3 * BucketSize) {
+          if(claim(base + code - 2 * BucketSize, digest, value))
+            return INSERT_SUCCESS;
+          continue;
+        }
+        bucket = (bucket + 1) % m_num_buckets;
+        ++probes;
+      }
+      return INSERT_FAILED;
+    }
+
+    template<class Member>
+    KOKKOS_INLINE_FUNCTION
+    InsertStatus insert(const Member& member, const HashDigest& digest, const Value& value) const {
+      uint32_t bucket = bucket_of(digest);
+      uint32_t probes = 0;
+      while(probes < m_num_buckets) {
+        uint32_t base = bucket * BucketSize;
+        int code = 3 * BucketSize;
+        Kokkos::parallel_reduce(Kokkos::ThreadVectorRange(member, BucketSize), [&](const int s, int& lcode) {
+          int slot_code = classify_for_insert(base, s, digest);
+          lcode = slot_code < lcode ? slot_code : lcode;
+        }, Kokkos::Min<int>(code));
+
+        if(code < BucketSize)
+          return INSERT_EXISTING;
+        if(code == BucketSize)
+          continue;
+        if(code < 3 * BucketSize) {
+          int claimed = 0;
+          Kokkos::single(Kokkos::PerThread(member), [&](int& lclaimed) {
+            lclaimed = claim(base + code - 2 * BucketSize, digest, value);
+          }, claimed);
+          if(claimed)
+            return INSERT_SUCCESS;
+          continue;
+        }
+        bucket = (bucket + 1) % m_num_buckets;
+        ++probes;
+      }
+      return INSERT_FAILED;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    uint32_t find(const HashDigest& digest) const {
+      uint32_t bucket = bucket_of(digest);
+      for(uint32_t probes = 0; probes < m_num_buckets; ++probes) {
+        uint32_t base = bucket * BucketSize;
+        int code = 2 * BucketSize;
+        for(int s = 0; s < BucketSize; ++s) {
+          int slot_code = classify_for_find(base, s, digest);
+          code = slot_code < code ? slot_code : code;
+        }
+
+        if(code < BucketSize)
+          return base + code;
+        if(code < 2 * BucketSize)
+          return invalid_index;
+        bucket = (bucket + 1) % m_num_buckets;
+      }
+      return invalid_index;
+    }
+
+    template<class Member>
+    KOKKOS_INLINE_FUNCTION
+    uint32_t find(const Member& member, const HashDigest& digest) const {
+      uint32_t bucket = bucket_of(digest);
+      for(uint32_t probes = 0; probes < m_num_buckets; ++probes) {
+        uint32_t base = bucket * BucketSize;
+        int code = 2 * BucketSize;
+        Kokkos::parallel_reduce(Kokkos::ThreadVectorRange(member, BucketSize), [&](const int s, int& lcode) {
+          int slot_code = classify_for_find(base, s, digest);
+          lcode = slot_code < lcode ? slot_code : lcode;
+        }, Kokkos::Min<int>(code));
+
+        if(code < BucketSize)
+          return base + code;
+        if(code < 2 * BucketSize)
+          return invalid_index;
+        bucket = (bucket + 1) % m_num_buckets;
+      }
+      return invalid_index;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    bool valid_at(uint32_t index) const {
+      return index != invalid_index;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Value& value_at(uint32_t index) const {
+      return m_values(index);
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    uint32_t capacity() const {
+      return m_num_buckets * BucketSize;
+    }
+
+    uint32_t size() const {
+      auto state = m_state;
+      uint32_t count = 0;
+      Kokkos::parallel_reduce("bucketed_size", Kokkos::RangePolicy<ExecSpace>(0, capacity()),
+      KOKKOS_LAMBDA(const int i, uint32_t& lcount) {
+        if(state(i) == SLOT_FULL)
+          lcount += 1;
+      }, count);
+      return count;
+    }
+
+    MapFootprint footprint() const {
+      MapFootprint total;
+      total.keys = capacity() * sizeof(HashDigest);
+      total.values = capacity() * sizeof(Value);
+      total.index = capacity() * sizeof(uint32_t);
+      total.bitset = 0;
+      return total;
+    }
+
+    void clear() {
+      Kokkos::deep_copy(m_state, (uint32_t)SLOT_EMPTY);
+    }
+
+  private:
+    /* Smaller codes take priority when reduced with Min:
+         s              FULL slot holding digest
+         BucketSize     BUSY slot, rescan the bucket
+         2*BucketSize+s EMPTY slot s
+         3*BucketSize   slot holds another key */
+    KOKKOS_FORCEINLINE_FUNCTION
+    int classify_for_insert(uint32_t base, int s, const HashDigest& digest) const {
+      uint32_t state = Kokkos::atomic_load(&m_state(base + s));
+      if(state == SLOT_FULL)
+        return digest_equal_to()(m_keys(base + s), digest) ? s : 3 * BucketSize;
+      if(state == SLOT_BUSY)
+        return BucketSize;
+      return 2 * BucketSize + s;
+    }
+
+    //s for a match, BucketSize+s for EMPTY (end of probe sequence), 2*BucketSize otherwise
+    KOKKOS_FORCEINLINE_FUNCTION
+    int classify_for_find(uint32_t base, int s, const HashDigest& digest) const {
+      uint32_t state = Kokkos::atomic_load(&m_state(base + s));
+      if(state == SLOT_FULL)
+        return digest_equal_to()(m_keys(base + s), digest) ? s : 2 * BucketSize;
+      if(state == SLOT_EMPTY)
+        return BucketSize + s;
+      return 2 * BucketSize;
+    }
+
+    KOKKOS_FORCEINLINE_FUNCTION
+    bool claim(uint32_t index, const HashDigest& digest, const Value& value) const {
+      if(Kokkos::atomic_compare_exchange(&m_state(index), (uint32_t)SLOT_EMPTY, (uint32_t)SLOT_BUSY) != SLOT_EMPTY)
+        return false;
+      m_keys(index) = digest;
+      m_values(index) = value;
+      Kokkos::memory_fence();
+      Kokkos::atomic_store(&m_state(index), (uint32_t)SLOT_FULL);
+      return true;
+    }
+
+    uint32_t m_num_buckets;
+    Kokkos::View<uint32_t*, memory_space> m_state;
+    Kokkos::View<HashDigest*, memory_space> m_keys;
+    Kokkos::View<Value*, memory_space> m_values;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef KOKKOS_GROWABLE_DIGEST_MAP_HPP
+#define KOKKOS_GROWABLE_DIGEST_MAP_HPP
+#include <Kokkos_Core.hpp>
+#include <Kokkos_UnorderedMap.hpp>
+#include <kokkos_murmur3.hpp>
+#include <map_helpers.hpp>
+#include <memory_accounting.hpp>
+
+/* Digest table that grows online instead of through a stop-the-world rehash.
+
+   All operations are batched kernels over [begin, end) of a digest View.
+   When an insert batch reports failed() inserts, a table growth_factor times
+   larger is allocated and becomes the insert target, the failed keys are
+   replayed into it, and the full table is kept read-only as m_old. Every
+   following insert batch first moves the next migrate_chunk slots of m_old
+   into the new table, so the copy is spread over many batches.
+
+   While migrating:
+     - find looks in the new table first, then in m_old (entries are never
+       removed from m_old until it has been fully drained)
+     - insert skips keys that still live in m_old, which keeps first writer
+       wins semantics; the old value is carried over by the migration
+
+   If the new table fills up before m_old is drained (an insert batch or a
+   migration chunk reports failed()), the table grows again: the rest of m_old
+   is drained into a table growth_factor times larger, and the full table
+   becomes the new m_old. No entry is dropped unless the larger table also
+   fails, and those are counted in the returned lost count.
+*/
+template<class Value, class ExecSpace = Kokkos::DefaultExecutionSpace>
+class GrowableDigestMap {
+  public:
+    using map_type = DigestMap<Value, ExecSpace>;
+    using execution_space = ExecSpace;
+    using memory_space = typename ExecSpace::memory_space;
+    using digest_view = Kokkos::View<HashDigest*, memory_space>;
+    using value_view = Kokkos::View<Value*, memory_space>;
+
+    GrowableDigestMap(uint32_t capacity, uint32_t migrate_chunk = 65536, uint32_t growth_factor = 2)
+      : m_current(capacity),
+        m_migrating(false),
+        m_cursor(0),
+        m_migrate_chunk(migrate_chunk),
+        m_growth_factor(growth_factor),
+        m_failed_idx("growable_failed_idx", 0),
+        m_failed_count("growable_failed_count") {}
+
+    //Returns the number of keys that could not be stored even after growing
+    uint32_t insert(digest_view digests, value_view values, uint32_t begin, uint32_t end) {
+      uint32_t num_lost = 0;
+      if(m_migrating)
+        num_lost += migrate_step();
+
+      if(m_failed_idx.extent(0) < end - begin)
+        Kokkos::realloc(m_failed_idx, end - begin);
+      Kokkos::deep_copy(m_failed_count, 0u);
+
+      map_type current = m_current;
+      map_type old = m_old;
+      bool migrating = m_migrating;
+      auto failed_idx = m_failed_idx;
+      auto failed_count = m_failed_count;
+      auto policy = Kokkos::RangePolicy<ExecSpace>(begin, end);
+      Kokkos::parallel_for("growable_insert", policy, KOKKOS_LAMBDA(const int i) {
+        if(migrating && old.exists(digests(i)))
+          return;
+        if(current.insert(digests(i), values(i)).failed()) {
+          uint32_t slot = Kokkos::atomic_fetch_add(&failed_count(), 1u);
+          failed_idx(slot) = i;
+        }
+      });
+      Kokkos::fence();
+
+      uint32_t num_failed = 0;
+      Kokkos::deep_copy(num_failed, m_failed_count);
+      if(num_failed == 0)
+        return num_lost;
+
+      num_lost += grow();
+
+      uint32_t replay_lost = 0;
+      current = m_current;
+      Kokkos::parallel_reduce("growable_replay", Kokkos::RangePolicy<ExecSpace>(0, num_failed),
+      KOKKOS_LAMBDA(const int j, uint32_t& lost) {
+        uint32_t i = failed_idx(j);
+        if(current.insert(digests(i), values(i)).failed())
+          lost += 1;
+      }, replay_lost);
+      Kokkos::fence();
+      return num_lost + replay_lost;
+    }
+
+    //Returns the number of digests in [begin, end) present in the table
+    uint32_t find(digest_view digests, uint32_t begin, uint32_t end) const {
+      map_type current = m_current;
+      map_type old = m_old;
+      bool migrating = m_migrating;
+      uint32_t hits = 0;
+      auto policy = Kokkos::RangePolicy<ExecSpace>(begin, end);
+      Kokkos::parallel_reduce("growable_find", policy, KOKKOS_LAMBDA(const int i, uint32_t& found) {
+        if(current.valid_at(current.find(digests(i))))
+          found += 1;
+        else if(migrating && old.valid_at(old.find(digests(i))))
+          found += 1;
+      }, hits);
+      Kokkos::fence();
+      return hits;
+    }
+
+    /* Moves the next migrate_chunk slots of the old table into the new one.
+       A chunk that does not fit grows the table instead of advancing the
+       cursor, so the whole chunk is drained again into the larger table.
+       Returns the number of entries lost. */
+    uint32_t migrate_step() {
+      if(!m_migrating)
+        return 0;
+
+      uint32_t old_capacity = m_old.capacity();
+      uint32_t stop = m_cursor + m_migrate_chunk;
+      if(stop > old_capacity)
+        stop = old_capacity;
+
+      if(drain(m_old, m_cursor, stop, m_current) > 0)
+        return grow();
+
+      m_cursor = stop;
+      if(m_cursor == old_capacity) {
+        m_old = map_type();
+        m_migrating = false;
+      }
+      return 0;
+    }
+
+    uint32_t finish_migration() {
+      uint32_t num_lost = 0;
+      while(m_migrating)
+        num_lost += migrate_step();
+      return num_lost;
+    }
+
+    bool migrating() const {
+      return m_migrating;
+    }
+
+    //Slots of the old table below the cursor are already counted by m_current
+    uint32_t size() const {
+      if(!m_migrating)
+        return m_current.size();
+
+      map_type old = m_old;
+      uint32_t pending = 0;
+      auto policy = Kokkos::RangePolicy<ExecSpace>(m_cursor, m_old.capacity());
+      Kokkos::parallel_reduce("growable_pending", policy, KOKKOS_LAMBDA(const int i, uint32_t& count) {
+        if(old.valid_at(i))
+          count += 1;
+      }, pending);
+      Kokkos::fence();
+      return m_current.size() + pending;
+    }
+
+    uint32_t capacity() const {
+      return m_current.capacity();
+    }
+
+    //Both tables while migrating
+    MapFootprint footprint() const {
+      MapFootprint total = map_footprint(m_current);
+      if(m_migrating)
+        total += map_footprint(m_old);
+      return total;
+    }
+
+  private:
+    //Inserts the valid slots [begin, end) of from into to, returns the number of failed inserts
+    static uint32_t drain(map_type from, uint32_t begin, uint32_t end, map_type to) {
+      uint32_t failed = 0;
+      auto policy = Kokkos::RangePolicy<ExecSpace>(begin, end);
+      Kokkos::parallel_reduce("growable_migrate", policy, KOKKOS_LAMBDA(const int i, uint32_t& count) {
+        if(from.valid_at(i) && to.insert(from.key_at(i), from.value_at(i)).failed())
+          count += 1;
+      }, failed);
+      Kokkos::fence();
+      return failed;
+    }
+
+    /* Allocates a table growth_factor times larger than m_current. A migration
+       still in flight drains the rest of m_old into it first, the full table
+       then becomes m_old and is migrated incrementally. Returns the number of
+       entries of m_old that did not fit. */
+    uint32_t grow() {
+      map_type bigger(m_current.capacity() * m_growth_factor);
+      uint32_t num_lost = 0;
+      if(m_migrating)
+        num_lost = drain(m_old, m_cursor, m_old.capacity(), bigger);
+
+      m_old = m_current;
+      m_current = bigger;
+      m_cursor = 0;
+      m_migrating = true;
+      return num_lost;
+    }
+
+    map_type m_current;
+    map_type m_old;
+    bool m_migrating;
+    uint32_t m_cursor;
+    uint32_t m_migrate_chunk;
+    uint32_t m_growth_factor;
+    Kokkos::View<uint32_t*, memory_space> m_failed_idx;
+    Kokkos::View<uint32_t, memory_space> m_failed_count;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef KOKKOS_HOST_THREADS_HPP
+#define KOKKOS_HOST_THREADS_HPP
+#include <Kokkos_Core.hpp>
+#include <thread>
+#include <vector>
+#ifdef KOKKOS_ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+/* Driving several execution space instances at once from the host.
+
+   Host backends run a kernel synchronously on the thread that submits it, so
+   kernels on different instances (Kokkos::Experimental::partition_space) only
+   overlap when each instance is driven by a host thread of its own. Under
+   OpenMP those threads come from a proc_bind(spread) region: each one keeps
+   its own slice of the place list, and the nested region the instance opens
+   stays inside it (OMP_PLACES=cores OMP_PROC_BIND=spread,close). Other
+   backends use unpinned std::threads.
+*/
+
+#ifdef KOKKOS_ENABLE_OPENMP
+//Instances from partition_space open nested parallel regions
+inline void enable_nested_host_regions() {
+  if(omp_get_max_active_levels() < 2)
+    omp_set_max_active_levels(2);
+}
+#endif
+
+inline void join_host_threads(std::vector<std::thread>& threads) {
+  for(auto& thread : threads)
+    thread.join();
+}
+
+/* Calls body(t) for every t in [0, num_threads). If the runtime delivers
+   fewer threads than asked for, some threads run several bodies one after
+   another, so the bodies must not wait on each other. */
+template<class Body>
+void for_each_host_thread(uint32_t num_threads, const Body& body) {
+#ifdef KOKKOS_ENABLE_OPENMP
+  enable_nested_host_regions();
+#pragma omp parallel num_threads(num_threads) proc_bind(spread)
+  {
+    for(uint32_t t = omp_get_thread_num(); t < num_threads; t += omp_get_num_threads())
+      body(t);
+  }
+#else
+  std::vector<std::thread> threads;
+  for(uint32_t t = 0; t < num_threads; ++t)
+    threads.emplace_back([&body, t]() { body(t); });
+  join_host_threads(threads);
+#endif
+}
+
+/* Calls body(t) for every t in [0, num_threads), each on a thread of its own,
+   so the bodies may wait on each other. Under OpenMP the region is only used
+   when it delivers all num_threads threads, otherwise no body runs there and
+   they all fall back to std::threads. */
+template<class Body>
+void for_each_concurrent_host_thread(uint32_t num_threads, const Body& body) {
+#ifdef KOKKOS_ENABLE_OPENMP
+  enable_nested_host_regions();
+  bool pinned = false;
+#pragma omp parallel num_threads(num_threads) proc_bind(spread)
+  {
+    if((uint32_t)omp_get_num_threads() == num_threads) {
+      if(omp_get_thread_num() == 0)
+        pinned = true;
+      body(omp_get_thread_num());
+    }
+  }
+  if(pinned)
+    return;
+#endif
+  std::vector<std::thread> threads;
+  for(uint32_t t = 0; t < num_threads; ++t)
+    threads.emplace_back([&body, t]() { body(t); });
+  join_host_threads(threads);
+}
+
+//Instance of ExecSpace limited to num_threads threads, all of them for 0
+template<class ExecSpace>
+ExecSpace thread_budget_space(int num_threads) {
+  int concurrency = ExecSpace().concurrency();
+  if(num_threads <= 0 || num_threads >= concurrency)
+    return ExecSpace();
+  return Kokkos::Experimental::partition_space(ExecSpace(), std::vector<int>{num_threads, concurrency - num_threads})[0];
+}
+
+#endif
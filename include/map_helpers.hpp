@@ -118,5 +118,99 @@ using DigestIdxHostMap   = DigestMap<uint32_t, Kokkos::DefaultHostExecutionSpace
 
 using IdxNodeIDDeviceMap = Kokkos::UnorderedMap<uint32_t, NodeID>;
 using IdxNodeIDHostMap = Kokkos::UnorderedMap<uint32_t, NodeID, Kokkos::DefaultHostExecutionSpace>;
+
+//Integer keys are already well spread indices, Kokkos::pod_hash runs full MurmurHash3 over their 4 bytes
+struct idx_fmix_hash {
+  using argument_type        = uint32_t;
+  using first_argument_type  = uint32_t;
+  using second_argument_type = uint32_t;
+  using result_type          = uint32_t;
+
+  KOKKOS_FORCEINLINE_FUNCTION
+  uint32_t operator()(uint32_t const& idx) const {
+    return kokkos_murmur3::fmix32(idx);
+  }
+
+  KOKKOS_FORCEINLINE_FUNCTION
+  uint32_t operator()(uint32_t const& idx, uint32_t seed) const {
+    return kokkos_murmur3::fmix32(idx ^ seed);
+  }
+};
+
+//Identity for dense indices, consecutive keys land in consecutive buckets
+struct idx_identity_hash {
+  using argument_type        = uint32_t;
+  using first_argument_type  = uint32_t;
+  using second_argument_type = uint32_t;
+  using result_type          = uint32_t;
+
+  KOKKOS_FORCEINLINE_FUNCTION
+  uint32_t operator()(uint32_t const& idx) const {
+    return idx;
+  }
+
+  KOKKOS_FORCEINLINE_FUNCTION
+  uint32_t operator()(uint32_t const& idx, uint32_t seed) const {
+    return idx ^ seed;
+  }
+};
+
+template<class Value, class ExecSpace, class Hasher = idx_fmix_hash>
+using IdxMap = Kokkos::UnorderedMap<uint32_t, Value, ExecSpace, Hasher>;
+using IdxNodeIDFmixDeviceMap = IdxMap<NodeID, Kokkos::DefaultExecutionSpace>;
+using IdxIdxFmixDeviceMap = IdxMap<uint32_t, Kokkos::DefaultExecutionSpace>;
+using IdxNodeIDIdentityDeviceMap = IdxMap<NodeID, Kokkos::DefaultExecutionSpace, idx_identity_hash>;
+
+// Combiners for upsert(). They are applied atomically to the value already
+// stored under a key whenever an insert finds that key present.
+struct UpsertAdd {
+  template<class Value>
+  KOKKOS_FORCEINLINE_FUNCTION
+  void operator()(Value& existing, const Value& incoming) const {
+    Kokkos::atomic_add(&existing, incoming);
+  }
+};
+
+struct UpsertMin {
+  template<class Value>
+  KOKKOS_FORCEINLINE_FUNCTION
+  void operator()(Value& existing, const Value& incoming) const {
+    Kokkos::atomic_fetch_min(&existing, incoming);
+  }
+};
+
+struct UpsertMax {
+  template<class Value>
+  KOKKOS_FORCEINLINE_FUNCTION
+  void operator()(Value& existing, const Value& incoming) const {
+    Kokkos::atomic_fetch_max(&existing, incoming);
+  }
+};
+
+// Insert-or-update in a single probe: the first writer stores value, every
+// later writer of the same key combines into the stored value through the
+// slot index that insert() already returned, so no second find() is needed.
+// The winning insert writes its value before linking the slot into the
+// bucket chain, so losers never combine into an uninitialized value.
+template<class Map, class Combiner>
+KOKKOS_INLINE_FUNCTION
+Kokkos::UnorderedMapInsertResult upsert(const Map& map,
+                                        const typename Map::key_type& key,
+                                        const typename Map::value_type& value,
+                                        const Combiner& combine) {
+  Kokkos::UnorderedMapInsertResult result = map.insert(key, value);
+  if(result.existing()) {
+    combine(map.value_at(result.index()), value);
+  }
+  return result;
+}
+
+template<class Map>
+KOKKOS_INLINE_FUNCTION
+Kokkos::UnorderedMapInsertResult upsert(const Map& map,
+                                        const typename Map::key_type& key,
+                                        const typename Map::value_type& value) {
+  return upsert(map, key, value, UpsertAdd());
+}
 #endif
 
@@ -0,0 +1,121 @@
+#ifndef KOKKOS_MEMORY_ACCOUNTING_HPP
+#define KOKKOS_MEMORY_ACCOUNTING_HPP
+#include <Kokkos_Core.hpp>
+#include <Kokkos_UnorderedMap.hpp>
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+
+//Bytes allocated by a table, split by array
+struct MapFootprint {
+  size_t keys;
+  size_t values;
+  size_t index;   //UnorderedMap next indices and bucket heads, slot states for bucketed tables
+  size_t bitset;  //UnorderedMap slot occupancy bitset
+
+  size_t total() const {
+    return keys + values + index + bitset;
+  }
+
+  MapFootprint& operator+=(const MapFootprint& other) {
+    keys += other.keys;
+    values += other.values;
+    index += other.index;
+    bitset += other.bitset;
+    return *this;
+  }
+};
+
+template<class Key, class Value, class Device, class Hasher, class EqualTo>
+MapFootprint map_footprint(const Kokkos::UnorderedMap<Key, Value, Device, Hasher, EqualTo>& map) {
+  using map_type = Kokkos::UnorderedMap<Key, Value, Device, Hasher, EqualTo>;
+  size_t capacity = map.capacity();
+  size_t hash_size = capacity == 0 ? 0 : Kokkos::Impl::find_hash_size(map.capacity());
+
+  MapFootprint footprint;
+  footprint.keys = capacity * sizeof(typename map_type::key_type);
+  footprint.values = capacity * sizeof(typename map_type::value_type);
+  footprint.index = (capacity + 1 + hash_size) * sizeof(typename map_type::size_type);
+  footprint.bitset = ((capacity + 31) / 32) * sizeof(uint32_t);
+  return footprint;
+}
+
+//Peak resident set size of the process in bytes
+inline size_t peak_rss_bytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+}
+
+/* Effective bytes moved by one UnorderedMap operation. The model assumes the
+   first probe resolves it (bucket head, one next index, one stored key), so
+   longer chains at high fill only add traffic and the reported bandwidth is
+   a lower bound. */
+template<class Map>
+size_t find_bytes() {
+  return sizeof(typename Map::key_type)    //probe key from the sample view
+       + sizeof(typename Map::size_type)   //bucket head
+       + sizeof(typename Map::key_type)    //stored key compared
+       + sizeof(typename Map::size_type);  //next index
+}
+
+template<class Map>
+size_t insert_bytes() {
+  return find_bytes<Map>()
+       + sizeof(uint32_t)                  //sample_data read for the value
+       + sizeof(uint32_t)                  //bitset word claimed
+       + sizeof(typename Map::key_type)    //slot key written
+       + sizeof(typename Map::value_type)  //slot value written
+       + sizeof(typename Map::size_type);  //slot linked into its bucket
+}
+
+//Key already present, atomic read-modify-write of its value
+template<class Map>
+size_t upsert_bytes() {
+  return find_bytes<Map>() + 2 * sizeof(typename Map::value_type);
+}
+
+//Key already present, found a second time before the atomic
+template<class Map>
+size_t two_step_bytes() {
+  return 2 * find_bytes<Map>() + 2 * sizeof(typename Map::value_type);
+}
+
+//Bucketed tables read every slot state of the home bucket
+template<class Map>
+size_t bucketed_find_bytes() {
+  return sizeof(typename Map::key_type)
+       + Map::bucket_size * sizeof(uint32_t)
+       + sizeof(typename Map::key_type);
+}
+
+template<class Map>
+size_t bucketed_insert_bytes() {
+  return bucketed_find_bytes<Map>()
+       + sizeof(uint32_t)                  //sample_data read for the value
+       + 2 * sizeof(uint32_t)              //slot state claimed and published
+       + sizeof(typename Map::key_type)
+       + sizeof(typename Map::value_type);
+}
+
+/* Suffix appended to a result line:
+     BW   effective bandwidth in GB/s from bytes_touched over seconds
+     A    allocated bytes of the table, then AK/AV/AI/AB per array
+     BPE  allocated bytes per stored entry
+     RSS  peak resident set size of the process in bytes */
+inline std::string memory_fields(const MapFootprint& footprint, size_t stored, double bytes_touched, double seconds) {
+  double bandwidth = seconds > 0 ? bytes_touched / seconds / 1e9 : 0;
+  double per_entry = stored > 0 ? (double)footprint.total() / stored : 0;
+
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "BW %lf A %zu AK %zu AV %zu AI %zu AB %zu BPE %lf RSS %zu",
+           bandwidth, footprint.total(), footprint.keys, footprint.values, footprint.index, footprint.bitset,
+           per_entry, peak_rss_bytes());
+  return std::string(buffer);
+}
+
+#endif
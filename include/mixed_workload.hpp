@@ -0,0 +1,212 @@
+#ifndef KOKKOS_MIXED_WORKLOAD_HPP
+#define KOKKOS_MIXED_WORKLOAD_HPP
+#include <Kokkos_Core.hpp>
+#include <Kokkos_UnorderedMap.hpp>
+#include <kokkos_murmur3.hpp>
+#include <map_helpers.hpp>
+#include <algorithm>
+#include <vector>
+
+/* YCSB-style mixed workload on a long-lived DigestNodeIDDeviceMap.
+
+   Every index of a single parallel region draws an operation from the mix and
+   a key from the sample digests:
+     find   -> one of the live keys [0, live_keys)
+     insert -> one of the fresh keys [fresh_begin, fresh_begin + fresh_keys)
+     erase  -> any live or fresh key
+
+   fresh_begin >= live_keys; keys in between (fresh keys of earlier runs) are
+   never touched, so every insert targets a key no earlier run stored.
+
+   Kokkos::UnorderedMap rejects inserts while it is erasable, so erase cannot
+   run concurrently with insert through the map itself. Erase instead writes a
+   tombstone (NodeID() == {UINT_MAX, UINT_MAX}) into the value, finds treat a
+   tombstoned entry as absent and inserts revive it. Fresh keys are drawn with
+   repetition, so a fresh key erased after its insert is revived by a later
+   one. compact_tombstones() removes tombstoned keys between runs with
+   begin_erase()/end_erase().
+
+   The caller sizes fresh_keys so that every fresh key fits into the table;
+   inserts that still fail are counted, not retried.
+
+   One op out of every sample_every is timed with Kokkos::Impl::clock_tic(),
+   the others take no timestamp. Ticks are converted to nanoseconds with the
+   rate measured by clock_ticks_per_ns() on the same execution space.
+*/
+
+enum WorkloadOp {
+  WORKLOAD_FIND = 0,
+  WORKLOAD_INSERT = 1,
+  WORKLOAD_ERASE = 2,
+  WORKLOAD_NUM_OPS = 3
+};
+
+//Percentages, must add up to 100
+struct WorkloadMix {
+  int find;
+  int insert;
+  int erase;
+};
+
+//Nanoseconds
+struct WorkloadLatency {
+  uint64_t samples;
+  double p50;
+  double p90;
+  double p99;
+  double p999;
+};
+
+struct WorkloadResult {
+  double seconds;
+  uint32_t num_ops;
+  uint32_t find_hits;
+  uint32_t failed_inserts;
+  uint32_t revived;
+  double ticks_per_ns;
+  WorkloadLatency latency[WORKLOAD_NUM_OPS];
+
+  double mops() const {
+    return num_ops / seconds / 1e6;
+  }
+};
+
+KOKKOS_INLINE_FUNCTION
+uint64_t* node_id_bits(NodeID& id) {
+  return reinterpret_cast<uint64_t*>(&id);
+}
+
+KOKKOS_INLINE_FUNCTION
+uint64_t node_id_tombstone() {
+  NodeID tombstone;
+  return *node_id_bits(tombstone);
+}
+
+KOKKOS_INLINE_FUNCTION
+bool node_id_live(NodeID id) {
+  return !(id == NodeID());
+}
+
+/* Rate of Kokkos::Impl::clock_tic() on the default execution space: a single
+   iteration kernel spins for spin_ticks, timed from the host. Launch overhead
+   is a few microseconds against tens of milliseconds of spinning. */
+inline double clock_ticks_per_ns(uint64_t spin_ticks = 1ull << 26) {
+  Kokkos::Timer timer;
+  Kokkos::parallel_for("clock_tic_calibrate", 1, KOKKOS_LAMBDA(const int) {
+    uint64_t start = Kokkos::Impl::clock_tic();
+    while(Kokkos::Impl::clock_tic() - start < spin_ticks) {}
+  });
+  Kokkos::fence();
+  return spin_ticks / (timer.seconds() * 1e9);
+}
+
+inline WorkloadLatency percentiles(std::vector<uint64_t>& ticks, double ticks_per_ns) {
+  WorkloadLatency latency = {ticks.size(), 0, 0, 0, 0};
+  if(ticks.empty())
+    return latency;
+
+  std::sort(ticks.begin(), ticks.end());
+  auto at = [&](double q) { return ticks[(size_t)(q * (ticks.size() - 1))] / ticks_per_ns; };
+  latency.p50 = at(0.50);
+  latency.p90 = at(0.90);
+  latency.p99 = at(0.99);
+  latency.p999 = at(0.999);
+  return latency;
+}
+
+inline WorkloadResult run_mixed_workload(DigestNodeIDDeviceMap device_hash, Kokkos::View<HashDigest*> sample_digests,
+                                         WorkloadMix mix, uint32_t live_keys, uint32_t fresh_begin, uint32_t fresh_keys, uint32_t num_ops,
+                                         uint32_t seed = 0, uint32_t sample_every = 64) {
+  static double ticks_per_ns = clock_ticks_per_ns();
+  uint32_t num_samples = (num_ops + sample_every - 1) / sample_every;
+  Kokkos::View<uint64_t*> sample_ticks("sample_ticks", num_samples);
+  Kokkos::View<uint8_t*> sample_ops("sample_ops", num_samples);
+  //Rare events, counted with atomics: failed inserts, revived tombstones
+  Kokkos::View<uint32_t*> events("workload_events", 2);
+  int find_cut = mix.find;
+  int insert_cut = mix.find + mix.insert;
+  uint32_t all_keys = live_keys + fresh_keys;
+
+  std::string label = "Mixed Workload -- " + std::to_string(mix.find) + "/"
+  + std::to_string(mix.insert) + "/" + std::to_string(mix.erase);
+
+  uint32_t find_hits = 0;
+  Kokkos::Timer timer;
+  Kokkos::parallel_reduce(label, num_ops, KOKKOS_LAMBDA(const int i, uint32_t& hits) {
+    uint32_t r = kokkos_murmur3::fmix32(i ^ seed);
+    uint32_t key_r = kokkos_murmur3::fmix32(r);
+    int pick = r % 100;
+    uint8_t op;
+
+    bool sampled = i % sample_every == 0;
+    uint64_t start = sampled ? Kokkos::Impl::clock_tic() : 0;
+    if(pick < find_cut) {
+      op = WORKLOAD_FIND;
+      uint32_t idx = device_hash.find(sample_digests(key_r % live_keys));
+      if(device_hash.valid_at(idx) && node_id_live(device_hash.value_at(idx)))
+        hits += 1;
+    } else if(pick < insert_cut) {
+      op = WORKLOAD_INSERT;
+      uint32_t key = fresh_begin + key_r % fresh_keys;
+      NodeID value(key, 1);
+      auto result = device_hash.insert(sample_digests(key), value);
+      if(result.failed())
+        Kokkos::atomic_increment(&events(0));
+      else if(result.existing()) {
+        uint64_t* bits = node_id_bits(device_hash.value_at(result.index()));
+        if(Kokkos::atomic_compare_exchange(bits, node_id_tombstone(), *node_id_bits(value)) == node_id_tombstone())
+          Kokkos::atomic_increment(&events(1));
+      }
+    } else {
+      op = WORKLOAD_ERASE;
+      uint32_t key = key_r % all_keys;
+      key = key < live_keys ? key : fresh_begin + (key - live_keys);
+      uint32_t idx = device_hash.find(sample_digests(key));
+      if(device_hash.valid_at(idx))
+        Kokkos::atomic_exchange(node_id_bits(device_hash.value_at(idx)), node_id_tombstone());
+    }
+
+    if(sampled) {
+      uint64_t stop = Kokkos::Impl::clock_tic();
+      sample_ticks(i / sample_every) = stop - start;
+      sample_ops(i / sample_every) = op;
+    }
+  }, find_hits);
+  Kokkos::fence();
+
+  WorkloadResult result;
+  result.seconds = timer.seconds();
+  result.num_ops = num_ops;
+  result.find_hits = find_hits;
+  result.ticks_per_ns = ticks_per_ns;
+
+  auto counts = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), events);
+  result.failed_inserts = counts(0);
+  result.revived = counts(1);
+
+  auto ticks = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), sample_ticks);
+  auto ops = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), sample_ops);
+  std::vector<uint64_t> per_op[WORKLOAD_NUM_OPS];
+  for(uint32_t s = 0; s < num_samples; ++s)
+    per_op[ops(s)].push_back(ticks(s));
+  for(int op = 0; op < WORKLOAD_NUM_OPS; ++op)
+    result.latency[op] = percentiles(per_op[op], ticks_per_ns);
+
+  return result;
+}
+
+//Physically removes tombstoned entries, must not overlap with other operations
+inline uint32_t compact_tombstones(DigestNodeIDDeviceMap device_hash) {
+  uint32_t removed = 0;
+  device_hash.begin_erase();
+  Kokkos::parallel_reduce("compact_tombstones", device_hash.capacity(), KOKKOS_LAMBDA(const int i, uint32_t& count) {
+    if(device_hash.valid_at(i) && !node_id_live(device_hash.value_at(i))) {
+      if(device_hash.erase(device_hash.key_at(i)))
+        count += 1;
+    }
+  }, removed);
+  device_hash.end_erase();
+  return removed;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef KOKKOS_SHARDED_DIGEST_MAP_HPP
+#define KOKKOS_SHARDED_DIGEST_MAP_HPP
+#include <Kokkos_Core.hpp>
+#include <Kokkos_UnorderedMap.hpp>
+#include <kokkos_murmur3.hpp>
+#include <map_helpers.hpp>
+#include <memory_accounting.hpp>
+#include <host_threads.hpp>
+#include <vector>
+
+/* Digest table split into num_shards independent UnorderedMaps.
+
+   The execution space is partitioned into one instance per shard
+   (Kokkos::Experimental::partition_space). Host backends dispatch a kernel
+   synchronously from the calling thread, so every shard's kernels are
+   submitted from a host thread of its own (for_each_shard) and the shards
+   run concurrently instead of one after another.
+
+   With the OpenMP backend those submitting threads come from an outer
+   parallel region with proc_bind(spread), which hands each of them its own
+   slice of the place list; the nested region of the shard's instance stays
+   inside that slice. Run with OMP_PLACES=cores OMP_PROC_BIND=spread,close
+   and one shard per socket, and every shard is allocated, first-touched and
+   later probed by threads of the same socket. Other backends fall back to
+   one unpinned std::thread per shard.
+
+   Batched operations are routed before they run: the digests of a batch are
+   bucketed by shard into a permutation (counting sort), then every shard's
+   instance processes only its own range of the permutation.
+
+   num_threads caps the total number of threads (0 uses all of them), split
+   evenly between the shards; routing runs on an instance of the same size.
+*/
+
+template<class Value, class ExecSpace = Kokkos::DefaultHostExecutionSpace>
+class ShardedDigestMap {
+  public:
+    using map_type = DigestMap<Value, ExecSpace>;
+    using execution_space = ExecSpace;
+    using memory_space = typename ExecSpace::memory_space;
+    using digest_view = Kokkos::View<HashDigest*, memory_space>;
+    using value_view = Kokkos::View<Value*, memory_space>;
+
+    ShardedDigestMap(uint32_t capacity, uint32_t num_shards, int num_threads = 0)
+      : m_num_shards(num_shards),
+        m_num_threads(num_threads > 0 && num_threads < ExecSpace().concurrency() ? num_threads : ExecSpace().concurrency()),
+        m_route_space(thread_budget_space<ExecSpace>(num_threads)),
+        m_instances(partition_shards(num_shards, num_threads)),
+        m_shards(num_shards),
+        m_offsets(num_shards + 1, 0),
+        m_perm("shard_perm", 0),
+        m_cursor("shard_cursor", num_shards) {
+      uint32_t shard_capacity = (capacity + num_shards - 1) / num_shards;
+      for_each_shard([&](uint32_t s) {
+#if KOKKOS_VERSION >= 40200
+        m_shards[s] = map_type(Kokkos::view_alloc(m_instances[s]), shard_capacity);
+#else
+        //No allocation properties for UnorderedMap before 4.2, placement falls back to the default instance
+        m_shards[s] = map_type(shard_capacity);
+#endif
+        m_instances[s].fence();
+      });
+    }
+
+    //Shards on the top digest word, buckets inside a shard come from the bottom one (digest_hash)
+    KOKKOS_INLINE_FUNCTION
+    static uint32_t shard_of(const HashDigest& digest, uint32_t num_shards) {
+      uint32_t high = ((const uint32_t*)(digest.digest))[3];
+      return (uint32_t)(((uint64_t)high * num_shards) >> 32);
+    }
+
+    void insert(digest_view digests, value_view values, uint32_t begin, uint32_t end) {
+      route(digests, begin, end);
+
+      auto perm = m_perm;
+      for_each_shard([&](uint32_t s) {
+        map_type shard = m_shards[s];
+        auto policy = Kokkos::RangePolicy<ExecSpace>(m_instances[s], m_offsets[s], m_offsets[s + 1]);
+        Kokkos::parallel_for("sharded_insert", policy, KOKKOS_LAMBDA(const int i) {
+          uint32_t idx = perm(i);
+          shard.insert(digests(idx), values(idx));
+        });
+        m_instances[s].fence();
+      });
+    }
+
+    //Returns the number of digests in [begin, end) present in the table
+    uint32_t find(digest_view digests, uint32_t begin, uint32_t end) {
+      route(digests, begin, end);
+
+      auto perm = m_perm;
+      std::vector<uint32_t> hits(m_num_shards, 0);
+      for_each_shard([&](uint32_t s) {
+        map_type shard = m_shards[s];
+        auto policy = Kokkos::RangePolicy<ExecSpace>(m_instances[s], m_offsets[s], m_offsets[s + 1]);
+        Kokkos::parallel_reduce("sharded_find", policy, KOKKOS_LAMBDA(const int i, uint32_t& found) {
+          if(shard.valid_at(shard.find(digests(perm(i)))))
+            found += 1;
+        }, hits[s]);
+      });
+
+      uint32_t total = 0;
+      for(uint32_t s = 0; s < m_num_shards; ++s)
+        total += hits[s];
+      return total;
+    }
+
+    void clear() {
+      for(uint32_t s = 0; s < m_num_shards; ++s)
+        m_shards[s].clear();
+    }
+
+    uint32_t size() const {
+      uint32_t total = 0;
+      for(uint32_t s = 0; s < m_num_shards; ++s)
+        total += m_shards[s].size();
+      return total;
+    }
+
+    uint32_t capacity() const {
+      uint32_t total = 0;
+      for(uint32_t s = 0; s < m_num_shards; ++s)
+        total += m_shards[s].capacity();
+      return total;
+    }
+
+    MapFootprint footprint() const {
+      MapFootprint total = {0, 0, 0, 0};
+      for(uint32_t s = 0; s < m_num_shards; ++s)
+        total += map_footprint(m_shards[s]);
+      return total;
+    }
+
+    uint32_t num_shards() const {
+      return m_num_shards;
+    }
+
+    int num_threads() const {
+      return m_num_threads;
+    }
+
+    //Counting sort of batch indices by shard into m_perm, ranges in m_offsets
+    void route(digest_view digests, uint32_t begin, uint32_t end) {
+      if(m_perm.extent(0) < end - begin)
+        Kokkos::realloc(m_perm, end - begin);
+
+      auto cursor = m_cursor;
+      auto perm = m_perm;
+      uint32_t num_shards = m_num_shards;
+      Kokkos::deep_copy(cursor, 0u);
+      auto policy = Kokkos::RangePolicy<ExecSpace>(m_route_space, begin, end);
+      Kokkos::parallel_for("shard_count", policy, KOKKOS_LAMBDA(const int i) {
+        Kokkos::atomic_increment(&cursor(shard_of(digests(i), num_shards)));
+      });
+      m_route_space.fence();
+
+      auto counts = Kokkos::create_mirror_view(cursor);
+      Kokkos::deep_copy(counts, cursor);
+      m_offsets[0] = 0;
+      for(uint32_t s = 0; s < m_num_shards; ++s) {
+        m_offsets[s + 1] = m_offsets[s] + counts(s);
+        counts(s) = m_offsets[s];
+      }
+      Kokkos::deep_copy(cursor, counts);
+
+      Kokkos::parallel_for("shard_scatter", policy, KOKKOS_LAMBDA(const int i) {
+        uint32_t pos = Kokkos::atomic_fetch_add(&cursor(shard_of(digests(i), num_shards)), 1u);
+        perm(pos) = i;
+      });
+      m_route_space.fence();
+    }
+
+  private:
+    //One equal instance per shard out of the num_threads budget, the idle remainder is dropped
+    static std::vector<ExecSpace> partition_shards(uint32_t num_shards, int num_threads) {
+      int concurrency = ExecSpace().concurrency();
+      if(num_shards == 0 || (int)num_shards > concurrency)
+        Kokkos::abort("ShardedDigestMap: num_shards must be between 1 and the host concurrency");
+      if(num_threads <= 0 || num_threads >= concurrency)
+        return Kokkos::Experimental::partition_space(ExecSpace(), std::vector<int>(num_shards, 1));
+
+      int per_shard = num_threads / num_shards > 0 ? num_threads / num_shards : 1;
+      std::vector<int> weights(num_shards, per_shard);
+      if(concurrency > per_shard * (int)num_shards)
+        weights.push_back(concurrency - per_shard * num_shards);
+      auto instances = Kokkos::Experimental::partition_space(ExecSpace(), weights);
+      instances.resize(num_shards);
+      return instances;
+    }
+
+    //Calls body(s) for every shard, each from its own host thread
+    template<class Body>
+    void for_each_shard(const Body& body) {
+      for_each_host_thread(m_num_shards, body);
+    }
+
+    uint32_t m_num_shards;
+    int m_num_threads;
+    ExecSpace m_route_space;
+    std::vector<ExecSpace> m_instances;
+    std::vector<map_type> m_shards;
+    std::vector<uint32_t> m_offsets;
+    Kokkos::View<uint32_t*, memory_space> m_perm;
+    Kokkos::View<uint32_t*, memory_space> m_cursor;
+};
+
+#endif
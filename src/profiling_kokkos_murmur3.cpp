@@ -3,7 +3,15 @@
 #include <Kokkos_Core.hpp>
 #include <kokkos_murmur3.hpp>
 #include <map_helpers.hpp>
+#include <growable_digest_map.hpp>
+#include <sharded_digest_map.hpp>
+#include <host_threads.hpp>
+#include <mixed_workload.hpp>
+#include <bucketed_digest_map.hpp>
+#include <memory_accounting.hpp>
 #include <math.h>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 /* Notes
@@ -104,19 +112,73 @@ void create_sample_data(Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDi
     Kokkos::fence();
 }
 
-void fill_until(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int fill_size) {
+//Views in the memory space of the map under test, so host maps get host data
+template<class Map>
+using KeyView = Kokkos::View<typename Map::key_type*, typename Map::memory_space>;
+template<class Map>
+using DataView = Kokkos::View<uint32_t*, typename Map::memory_space>;
+
+//Turns sample_data(i) into the value type of the map under test
+template<class Value>
+KOKKOS_INLINE_FUNCTION
+Value sample_value(uint32_t data);
+
+template<>
+KOKKOS_INLINE_FUNCTION
+NodeID sample_value<NodeID>(uint32_t data) {
+    return NodeID(data, 1);
+}
+
+template<>
+KOKKOS_INLINE_FUNCTION
+uint32_t sample_value<uint32_t>(uint32_t data) {
+    return data;
+}
+
+//Key generators, key i is derived from sample_data(i)
+struct DigestKeyGen {
+    using key_type = HashDigest;
+
+    KOKKOS_INLINE_FUNCTION
+    HashDigest operator()(uint32_t data) const {
+        HashDigest digest;
+        hash(&data, sizeof(data), digest.digest);
+        return digest;
+    }
+};
+
+struct IdxKeyGen {
+    using key_type = uint32_t;
+
+    KOKKOS_INLINE_FUNCTION
+    uint32_t operator()(uint32_t data) const {
+        return data;
+    }
+};
+
+/* The notebooks select rows by tag alone, so only the original
+   DigestNodeIDDeviceMap run prints the plain I/FT/SI/MI tags; every other map
+   prints TAG.<map_name>, e.g. I.IdxNodeIDDeviceMap. */
+template<class Map>
+std::string line_tag(const char* tag, const char* map_name) {
+    if(std::is_same<Map, DigestNodeIDDeviceMap>::value)
+        return tag;
+    return std::string(tag) + "." + map_name;
+}
+
+template<class Map>
+void fill_until(Map device_hash, DataView<Map> sample_data, KeyView<Map> sample_digests, int fill_size) {
     //This need serious reevaluation -- speak with Nigel
-    int init_size = device_hash.size();
-    auto policy = Kokkos::RangePolicy<>(0, fill_size);
+    using value_type = typename Map::value_type;
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(0, fill_size);
     Kokkos::parallel_for("hash_fill", policy, KOKKOS_LAMBDA(const int i) {
-        HashDigest digest = sample_digests(i);
-        device_hash.insert(digest, NodeID(sample_data(i), 1));
+        device_hash.insert(sample_digests(i), sample_value<value_type>(sample_data(i)));
     });
     Kokkos::fence();
-    int final_size = device_hash.size();
 }
 
-void insertion_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_insertions, int capacity, int percent_full) {
+template<class Map>
+void insertion_test(Map device_hash, DataView<Map> sample_data, KeyView<Map> sample_digests, int starting_index, int num_insertions, int capacity, int percent_full, const char* map_name) {
     if(num_insertions < 5120) {
         num_insertions = 5120;
         if(starting_index + num_insertions > capacity - 1)
@@ -127,21 +189,25 @@ void insertion_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> s
     std::string label = "Insertion Test -- Capacity = " + std::to_string(capacity)
     + " -- Percent Full = " + std::to_string(percent_full) + "%";
 
+    using value_type = typename Map::value_type;
     Kokkos::Timer timer; 
-    int init_size = device_hash.size();
-    auto policy = Kokkos::RangePolicy<>(starting_index, starting_index + num_insertions);
+    //size() launches a counting kernel; it stays inside the timed region so I stays comparable with data/
+    device_hash.size();
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(starting_index, starting_index + num_insertions);
     Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i) {
-        HashDigest digest = sample_digests(i);
-        device_hash.insert(digest, NodeID(sample_data(i), 1));
+        device_hash.insert(sample_digests(i), sample_value<value_type>(sample_data(i)));
     });
     Kokkos::fence();
     double time = timer.seconds();
-    int final_size = device_hash.size();
 
-    printf("I C %d F %d T %lf I %d\n", capacity, percent_full, time, num_insertions);
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)num_insertions * insert_bytes<Map>(), time);
+
+    printf("%s C %d F %d T %lf I %d M %s K %zu V %zu %s\n", line_tag<Map>("I", map_name).c_str(), capacity, percent_full, time, num_insertions,
+           map_name, sizeof(typename Map::key_type), sizeof(value_type), memory.c_str());
 }
 
-void find_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_finds, int capacity, int percent_full) {
+template<class Map>
+void find_test(Map device_hash, DataView<Map> sample_data, KeyView<Map> sample_digests, int starting_index, int num_finds, int capacity, int percent_full, const char* map_name) {
     if(num_finds < 5120) {
         num_finds = 5120;
         if(starting_index + num_finds > capacity - 1)
@@ -152,18 +218,21 @@ void find_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample
     + " -- Percent Full = " + std::to_string(percent_full) + "%";
 
     Kokkos::Timer timer; 
-    auto policy = Kokkos::RangePolicy<>(starting_index, starting_index + num_finds);
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(starting_index, starting_index + num_finds);
     Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i) {
         device_hash.find(sample_digests(i));
     });
     Kokkos::fence();
     double time = timer.seconds();
-    int size = device_hash.size();
 
-    printf("FT C %d F %d T %lf I %d\n", capacity, percent_full, time, num_finds);
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)num_finds * find_bytes<Map>(), time);
+
+    printf("%s C %d F %d T %lf I %d M %s K %zu V %zu %s\n", line_tag<Map>("FT", map_name).c_str(), capacity, percent_full, time, num_finds,
+           map_name, sizeof(typename Map::key_type), sizeof(typename Map::value_type), memory.c_str());
 }
 
-void single_rep_insert_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int insertion_index, int num_insertions, int capacity, int percent_full) {
+template<class Map>
+void single_rep_insert_test(Map device_hash, DataView<Map> sample_data, KeyView<Map> sample_digests, int insertion_index, int num_insertions, int capacity, int percent_full, const char* map_name) {
     if(num_insertions < 5120) {
         num_insertions = 5120;
     }
@@ -171,48 +240,673 @@ void single_rep_insert_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint
     std::string label = "Single Repeated Insertion Test -- Capacity = " + std::to_string(capacity)
     + " -- Percent Full = " + std::to_string(percent_full) + "%";
 
+    using value_type = typename Map::value_type;
     Kokkos::Timer timer; 
-    Kokkos::parallel_for(label, num_insertions, KOKKOS_LAMBDA(const int i) {
-        HashDigest digest = sample_digests(insertion_index);
-        device_hash.insert(digest, NodeID(1, 1));
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(0, num_insertions);
+    Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i) {
+        device_hash.insert(sample_digests(insertion_index), sample_value<value_type>(1));
     });
     Kokkos::fence();
     double time = timer.seconds();
-    int size = device_hash.size();
 
-    printf("SI C %d F %d T %lf I %d\n", capacity, percent_full, time, num_insertions);
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)num_insertions * find_bytes<Map>(), time);
+
+    printf("%s C %d F %d T %lf I %d M %s K %zu V %zu %s\n", line_tag<Map>("SI", map_name).c_str(), capacity, percent_full, time, num_insertions,
+           map_name, sizeof(typename Map::key_type), sizeof(value_type), memory.c_str());
 }
 
-void multiple_rep_insert_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int num_insertions, int capacity, int percent_full) {
+template<class Map>
+void multiple_rep_insert_test(Map device_hash, DataView<Map> sample_data, KeyView<Map> sample_digests, int num_insertions, int capacity, int percent_full, const char* map_name) {
     if(num_insertions < 5120) {
         num_insertions = 5120;
     }
     
     std::string label = "Multiple Repeated Insertion Test -- Capacity = " + std::to_string(capacity)
     + " -- Percent Full = " + std::to_string(percent_full) + "%";
+    using value_type = typename Map::value_type;
     Kokkos::Timer timer; 
+    auto policy = Kokkos::MDRangePolicy<typename Map::execution_space, Kokkos::Rank<2> > ({0,0}, {num_insertions,100});
+    Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i, const int j) {
+        device_hash.insert(sample_digests(j), sample_value<value_type>(1));
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), 100.0 * num_insertions * find_bytes<Map>(), time);
+
+    printf("%s C %d F %d T %lf I %d M %s K %zu V %zu %s\n", line_tag<Map>("MI", map_name).c_str(), capacity, percent_full, time, num_insertions,
+           map_name, sizeof(typename Map::key_type), sizeof(value_type), memory.c_str());
+}
+
+/* Runs the fill sweep of I/FT/SI/MI on a fresh map of any key/value type.
+   The sweep never reads past capacity + num_insertions, so only that prefix
+   of sample_data is copied and turned into keys. */
+template<class Map, class KeyGen>
+void key_type_sweep(Kokkos::View<uint32_t*> sample_data, KeyGen key_gen, int num_insertions, int capacity, const char* map_name) {
+    size_t num_keys = (size_t)capacity + num_insertions;
+    if(num_keys > sample_data.extent(0))
+        num_keys = sample_data.extent(0);
+    auto used_data = Kokkos::subview(sample_data, std::make_pair((size_t)0, num_keys));
+    auto map_data = Kokkos::create_mirror_view_and_copy(typename Map::memory_space(), used_data);
+    KeyView<Map> map_keys("sample_keys", map_data.extent(0));
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(0, map_data.extent(0));
+    Kokkos::parallel_for("key_gen", policy, KOKKOS_LAMBDA(const int i) {
+        map_keys(i) = key_gen(map_data(i));
+    });
+    Kokkos::fence();
+
+    Map device_hash;
+    device_hash.rehash(capacity);
+
+    for (int j = 0; j < 9; ++j) {
+        int percent_full = 10 * (j + 1);
+        int fill_size = (percent_full * capacity) / 100;
+
+        fill_until(device_hash, map_data, map_keys, fill_size);
+        insertion_test(device_hash, map_data, map_keys, fill_size, num_insertions, capacity, percent_full, map_name);
+        find_test(device_hash, map_data, map_keys, fill_size, num_insertions, capacity, percent_full, map_name);
+        single_rep_insert_test(device_hash, map_data, map_keys, 0, num_insertions, capacity, percent_full, map_name);
+        multiple_rep_insert_test(device_hash, map_data, map_keys, num_insertions, capacity, percent_full, map_name);
+
+        device_hash.clear();
+    }
+}
+
+//Host maps are the device maps on host-only builds, skip the duplicate sweep there
+template<class HostMap, class DeviceMap, class KeyGen>
+void host_key_type_sweep(Kokkos::View<uint32_t*> sample_data, KeyGen key_gen, int num_insertions, int capacity, const char* map_name) {
+    if(!std::is_same<HostMap, DeviceMap>::value)
+        key_type_sweep<HostMap>(sample_data, key_gen, num_insertions, capacity, map_name);
+}
+
+void fill_counts_until(DigestIdxDeviceMap count_hash, Kokkos::View<HashDigest*> sample_digests, int fill_size) {
+    auto policy = Kokkos::RangePolicy<>(0, fill_size);
+    Kokkos::parallel_for("count_fill", policy, KOKKOS_LAMBDA(const int i) {
+        upsert(count_hash, sample_digests(i), 1u);
+    });
+    Kokkos::fence();
+}
+
+void single_rep_upsert_test(DigestIdxDeviceMap count_hash, Kokkos::View<HashDigest*> sample_digests, int insertion_index, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+    }
+
+    std::string label = "Single Repeated Upsert Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    Kokkos::Timer timer;
+    Kokkos::parallel_for(label, num_insertions, KOKKOS_LAMBDA(const int i) {
+        HashDigest digest = sample_digests(insertion_index);
+        upsert(count_hash, digest, 1u, UpsertAdd());
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(count_hash), count_hash.size(), (double)num_insertions * upsert_bytes<DigestIdxDeviceMap>(), time);
+
+    printf("SU C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+//Baseline for SU: insert, and on an existing key find it again before the atomic
+void single_rep_two_step_test(DigestIdxDeviceMap count_hash, Kokkos::View<HashDigest*> sample_digests, int insertion_index, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+    }
+
+    std::string label = "Single Repeated Two-Step Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    Kokkos::Timer timer;
+    Kokkos::parallel_for(label, num_insertions, KOKKOS_LAMBDA(const int i) {
+        HashDigest digest = sample_digests(insertion_index);
+        if(count_hash.insert(digest, 1u).existing()) {
+            uint32_t idx = count_hash.find(digest);
+            Kokkos::atomic_add(&count_hash.value_at(idx), 1u);
+        }
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(count_hash), count_hash.size(), (double)num_insertions * two_step_bytes<DigestIdxDeviceMap>(), time);
+
+    printf("ST C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+void multiple_rep_upsert_test(DigestIdxDeviceMap count_hash, Kokkos::View<HashDigest*> sample_digests, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+    }
+
+    std::string label = "Multiple Repeated Upsert Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+    Kokkos::Timer timer;
     auto policy = Kokkos::MDRangePolicy< Kokkos::Rank<2> > ({0,0}, {num_insertions,100});
     Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i, const int j) {
         HashDigest digest = sample_digests(j);
-        device_hash.insert(digest, NodeID(1, 1));
+        upsert(count_hash, digest, 1u, UpsertAdd());
     });
     Kokkos::fence();
     double time = timer.seconds();
-    int size = device_hash.size();
 
-    printf("MI C %d F %d T %lf I %d\n", capacity, percent_full, time, num_insertions);
+    std::string memory = memory_fields(map_footprint(count_hash), count_hash.size(), (double)100.0 * num_insertions * upsert_bytes<DigestIdxDeviceMap>(), time);
+
+    printf("MU C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+//Baseline for MU
+void multiple_rep_two_step_test(DigestIdxDeviceMap count_hash, Kokkos::View<HashDigest*> sample_digests, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+    }
+
+    std::string label = "Multiple Repeated Two-Step Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+    Kokkos::Timer timer;
+    auto policy = Kokkos::MDRangePolicy< Kokkos::Rank<2> > ({0,0}, {num_insertions,100});
+    Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i, const int j) {
+        HashDigest digest = sample_digests(j);
+        if(count_hash.insert(digest, 1u).existing()) {
+            uint32_t idx = count_hash.find(digest);
+            Kokkos::atomic_add(&count_hash.value_at(idx), 1u);
+        }
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(count_hash), count_hash.size(), (double)100.0 * num_insertions * two_step_bytes<DigestIdxDeviceMap>(), time);
+
+    printf("MT C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+void fill_values(Kokkos::View<uint32_t*> sample_data, Kokkos::View<NodeID*> sample_values) {
+    Kokkos::parallel_for("value_fill", sample_values.extent(0), KOKKOS_LAMBDA(const int i) {
+        sample_values(i) = NodeID(sample_data(i), 1);
+    });
+    Kokkos::fence();
+}
+
+//Gathers count digests spread evenly over the keys [0, end) inserted so far
+void gather_inserted(Kokkos::View<HashDigest*> sample_digests, Kokkos::View<HashDigest*> find_digests, int end, int count) {
+    Kokkos::parallel_for("gather_inserted", count, KOKKOS_LAMBDA(const int j) {
+        find_digests(j) = sample_digests((uint64_t)j * end / count);
+    });
+    Kokkos::fence();
+}
+
+/* Grows from capacity/8 to hold 90% of capacity, one line per batch to expose
+   latency spikes. Every insert batch (GG) is followed by a find batch of the
+   same size over the keys inserted so far (GF), which probes both tables
+   while a migration is in flight. Each batch migrates num_insertions old
+   slots, so a migration spans several batches at every capacity. */
+void growable_insertion_test(Kokkos::View<HashDigest*> sample_digests, Kokkos::View<NodeID*> sample_values, int num_insertions, int capacity) {
+    GrowableDigestMap<NodeID> growable_hash(capacity / 8, num_insertions);
+    Kokkos::View<HashDigest*> find_digests("growable_find_digests", num_insertions);
+    int total = (9 * capacity) / 10;
+
+    for(int start = 0, batch = 0; start < total; start += num_insertions, ++batch) {
+        int end = start + num_insertions < total ? start + num_insertions : total;
+
+        Kokkos::Timer timer;
+        uint32_t lost = growable_hash.insert(sample_digests, sample_values, start, end);
+        double time = timer.seconds();
+        int percent_full = (int)((100.0 * end) / growable_hash.capacity());
+
+        std::string memory = memory_fields(growable_hash.footprint(), growable_hash.size(), (double)(end - start) * insert_bytes<DigestNodeIDDeviceMap>(), time);
+
+        printf("GG C %d F %d T %lf I %d B %d M %d L %u %s\n", capacity, percent_full, time, end - start, batch, growable_hash.migrating(), lost, memory.c_str());
+
+        int num_finds = end < num_insertions ? end : num_insertions;
+        gather_inserted(sample_digests, find_digests, end, num_finds);
+        timer.reset();
+        uint32_t hits = growable_hash.find(find_digests, 0, num_finds);
+        time = timer.seconds();
+
+        memory = memory_fields(growable_hash.footprint(), growable_hash.size(), (double)num_finds * find_bytes<DigestNodeIDDeviceMap>(), time);
+
+        printf("GF C %d F %d T %lf I %d B %d M %d H %u %s\n", capacity, percent_full, time, num_finds, batch, growable_hash.migrating(), hits, memory.c_str());
+    }
+}
+
+//Same batches as GG/GF, but a failed insert stops to rehash and replay the failed keys
+void rehash_insertion_test(Kokkos::View<HashDigest*> sample_digests, Kokkos::View<NodeID*> sample_values, int num_insertions, int capacity) {
+    DigestNodeIDDeviceMap device_hash(capacity / 8);
+    Kokkos::View<HashDigest*> find_digests("rehash_find_digests", num_insertions);
+    Kokkos::View<uint32_t*> failed_idx("failed_idx", num_insertions);
+    Kokkos::View<uint32_t> failed_count("failed_count");
+    int total = (9 * capacity) / 10;
+
+    for(int start = 0, batch = 0; start < total; start += num_insertions, ++batch) {
+        int end = start + num_insertions < total ? start + num_insertions : total;
+        int grew = 0;
+
+        Kokkos::Timer timer;
+        Kokkos::deep_copy(failed_count, 0u);
+        auto policy = Kokkos::RangePolicy<>(start, end);
+        Kokkos::parallel_for("rehash_insert", policy, KOKKOS_LAMBDA(const int i) {
+            if(device_hash.insert(sample_digests(i), sample_values(i)).failed()) {
+                uint32_t slot = Kokkos::atomic_fetch_add(&failed_count(), 1u);
+                failed_idx(slot) = i;
+            }
+        });
+        Kokkos::fence();
+        uint32_t num_failed = 0;
+        Kokkos::deep_copy(num_failed, failed_count);
+        if(num_failed > 0) {
+            device_hash.rehash(2 * device_hash.capacity());
+            Kokkos::parallel_for("rehash_replay", num_failed, KOKKOS_LAMBDA(const int j) {
+                uint32_t i = failed_idx(j);
+                device_hash.insert(sample_digests(i), sample_values(i));
+            });
+            Kokkos::fence();
+            grew = 1;
+        }
+        double time = timer.seconds();
+        int percent_full = (int)((100.0 * end) / device_hash.capacity());
+
+        std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)(end - start) * insert_bytes<DigestNodeIDDeviceMap>(), time);
+
+        printf("RG C %d F %d T %lf I %d B %d M %d %s\n", capacity, percent_full, time, end - start, batch, grew, memory.c_str());
+
+        int num_finds = end < num_insertions ? end : num_insertions;
+        gather_inserted(sample_digests, find_digests, end, num_finds);
+        uint32_t hits = 0;
+        timer.reset();
+        Kokkos::parallel_reduce("rehash_find", num_finds, KOKKOS_LAMBDA(const int j, uint32_t& found) {
+            if(device_hash.valid_at(device_hash.find(find_digests(j))))
+                found += 1;
+        }, hits);
+        Kokkos::fence();
+        time = timer.seconds();
+
+        memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)num_finds * find_bytes<DigestNodeIDDeviceMap>(), time);
+
+        printf("RF C %d F %d T %lf I %d B %d M %d H %u %s\n", capacity, percent_full, time, num_finds, batch, grew, hits, memory.c_str());
+    }
+}
+
+using HostDigestView = Kokkos::View<HashDigest*, Kokkos::HostSpace>;
+using HostNodeIDView = Kokkos::View<NodeID*, Kokkos::HostSpace>;
+
+//Counting and scatter passes each read the key, then the permutation is written and read back
+const size_t routing_bytes = 2 * sizeof(HashDigest) + 2 * sizeof(uint32_t);
+
+//Sharded counterparts of insertion_test and find_test, same ranges and clamping
+void sharded_insertion_test(ShardedDigestMap<NodeID>& sharded_hash, HostDigestView sample_digests, HostNodeIDView sample_values, int starting_index, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+        if(starting_index + num_insertions > capacity - 1)
+            num_insertions = capacity - starting_index - 1;
+    }
+
+    Kokkos::Timer timer;
+    sharded_hash.insert(sample_digests, sample_values, starting_index, starting_index + num_insertions);
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(sharded_hash.footprint(), sharded_hash.size(), (double)num_insertions * (insert_bytes<DigestNodeIDDeviceMap>() + routing_bytes), time);
+
+    printf("SHI C %d F %d T %lf I %d S %u N %d %s\n", capacity, percent_full, time, num_insertions, sharded_hash.num_shards(), sharded_hash.num_threads(), memory.c_str());
+}
+
+void sharded_find_test(ShardedDigestMap<NodeID>& sharded_hash, HostDigestView sample_digests, int starting_index, int num_finds, int capacity, int percent_full) {
+    if(num_finds < 5120) {
+        num_finds = 5120;
+        if(starting_index + num_finds > capacity - 1)
+            num_finds = capacity - starting_index - 1;
+    }
+
+    Kokkos::Timer timer;
+    sharded_hash.find(sample_digests, starting_index, starting_index + num_finds);
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(sharded_hash.footprint(), sharded_hash.size(), (double)num_finds * (find_bytes<DigestNodeIDDeviceMap>() + routing_bytes), time);
+
+    printf("SHF C %d F %d T %lf I %d S %u N %d %s\n", capacity, percent_full, time, num_finds, sharded_hash.num_shards(), sharded_hash.num_threads(), memory.c_str());
+}
+
+/* Thread scaling of sharded against monolithic at 50% fill. For every thread
+   budget N (powers of two up to the host concurrency) a single
+   DigestNodeIDHostMap driven by an N thread instance prints SMI/SMF, and a
+   ShardedDigestMap with the same budget prints SHI/SHF. */
+void thread_scaling_test(HostDigestView sample_digests, HostNodeIDView sample_values, int num_insertions, int capacity, int num_shards) {
+    using host_space = Kokkos::DefaultHostExecutionSpace;
+    int percent_full = 50;
+    int fill_size = (percent_full * capacity) / 100;
+    int concurrency = host_space().concurrency();
+
+    std::vector<int> thread_counts;
+    for(int num_threads = 1; num_threads < concurrency; num_threads *= 2)
+        thread_counts.push_back(num_threads);
+    thread_counts.push_back(concurrency);
+
+    for(int num_threads : thread_counts) {
+        host_space space = thread_budget_space<host_space>(num_threads);
+        DigestNodeIDHostMap host_hash(capacity);
+        Kokkos::parallel_for("scaling_fill", Kokkos::RangePolicy<host_space>(space, 0, fill_size), KOKKOS_LAMBDA(const int i) {
+            host_hash.insert(sample_digests(i), sample_values(i));
+        });
+        space.fence();
+
+        Kokkos::Timer timer;
+        Kokkos::parallel_for("scaling_insert", Kokkos::RangePolicy<host_space>(space, fill_size, fill_size + num_insertions), KOKKOS_LAMBDA(const int i) {
+            host_hash.insert(sample_digests(i), sample_values(i));
+        });
+        space.fence();
+        double time = timer.seconds();
+
+        std::string memory = memory_fields(map_footprint(host_hash), host_hash.size(), (double)num_insertions * insert_bytes<DigestNodeIDHostMap>(), time);
+        printf("SMI C %d F %d T %lf I %d S 1 N %d %s\n", capacity, percent_full, time, num_insertions, num_threads, memory.c_str());
+
+        uint32_t hits = 0;
+        timer.reset();
+        Kokkos::parallel_reduce("scaling_find", Kokkos::RangePolicy<host_space>(space, fill_size, fill_size + num_insertions), KOKKOS_LAMBDA(const int i, uint32_t& found) {
+            if(host_hash.valid_at(host_hash.find(sample_digests(i))))
+                found += 1;
+        }, hits);
+        time = timer.seconds();
+
+        memory = memory_fields(map_footprint(host_hash), host_hash.size(), (double)num_insertions * find_bytes<DigestNodeIDHostMap>(), time);
+        printf("SMF C %d F %d T %lf I %d S 1 N %d %s\n", capacity, percent_full, time, num_insertions, num_threads, memory.c_str());
+
+        //Every shard needs at least one thread
+        if(num_threads < num_shards)
+            continue;
+
+        ShardedDigestMap<NodeID> sharded_hash(capacity, num_shards, num_threads);
+        sharded_hash.insert(sample_digests, sample_values, 0, fill_size);
+        sharded_insertion_test(sharded_hash, sample_digests, sample_values, fill_size, num_insertions, capacity, percent_full);
+        sharded_find_test(sharded_hash, sample_digests, fill_size, num_insertions, capacity, percent_full);
+    }
+}
+
+/* Runs the mix on the live map, one summary line plus one latency line per op
+   type. Keys [0, live_keys) must be stored and no key from fresh_begin on.
+   At most max_fresh fresh keys are drawn, further capped by the free slots
+   of the table so no insert can overflow it; X counts the inserts that
+   failed anyway. Returns where the next run's fresh keys start. */
+int mixed_workload_test(DigestNodeIDDeviceMap device_hash, Kokkos::View<HashDigest*> sample_digests, WorkloadMix mix, int live_keys, int fresh_begin, int max_fresh, int num_ops, int capacity, int percent_full) {
+    int fresh_keys = max_fresh;
+    int free_slots = (int)device_hash.capacity() - (int)device_hash.size();
+    if(fresh_keys > free_slots)
+        fresh_keys = free_slots;
+    if(fresh_begin + fresh_keys > (int)sample_digests.extent(0))
+        fresh_keys = sample_digests.extent(0) - fresh_begin;
+    if(fresh_keys < 1)
+        fresh_keys = 1;
+
+    WorkloadResult result = run_mixed_workload(device_hash, sample_digests, mix, live_keys, fresh_begin, fresh_keys, num_ops, percent_full);
+    uint32_t removed = compact_tombstones(device_hash);
+
+    //Erase is a find plus an exchange on the value
+    double op_bytes[WORKLOAD_NUM_OPS] = {(double)find_bytes<DigestNodeIDDeviceMap>(), (double)insert_bytes<DigestNodeIDDeviceMap>(),
+                                         (double)(find_bytes<DigestNodeIDDeviceMap>() + 2 * sizeof(NodeID))};
+    int op_percent[WORKLOAD_NUM_OPS] = {mix.find, mix.insert, mix.erase};
+    double bytes_per_op = 0;
+    for(int op = 0; op < WORKLOAD_NUM_OPS; ++op)
+        bytes_per_op += op_percent[op] * op_bytes[op] / 100.0;
+    MapFootprint footprint = map_footprint(device_hash);
+    uint32_t stored = device_hash.size();
+    std::string memory = memory_fields(footprint, stored, num_ops * bytes_per_op, result.seconds);
+
+    printf("WL C %d F %d T %lf I %d R %d/%d/%d M %lf H %u E %u K %d X %u V %u %s\n", capacity, percent_full, result.seconds, num_ops,
+           mix.find, mix.insert, mix.erase, result.mops(), result.find_hits, removed, fresh_keys, result.failed_inserts,
+           result.revived, memory.c_str());
+
+    /* Percentiles in nanoseconds, TPN is the measured clock_tic rate they were
+       converted with. BW is the share of the run's traffic moved by that op type. */
+    const char* tags[WORKLOAD_NUM_OPS] = {"WLF", "WLI", "WLE"};
+    for(int op = 0; op < WORKLOAD_NUM_OPS; ++op) {
+        WorkloadLatency& lat = result.latency[op];
+        std::string op_memory = memory_fields(footprint, stored, num_ops * op_percent[op] * op_bytes[op] / 100.0, result.seconds);
+        printf("%s C %d F %d T %lf I %d R %d/%d/%d S %llu P50 %lf P90 %lf P99 %lf P999 %lf TPN %lf %s\n", tags[op], capacity, percent_full,
+               result.seconds, num_ops, mix.find, mix.insert, mix.erase, (unsigned long long)lat.samples,
+               lat.p50, lat.p90, lat.p99, lat.p999, result.ticks_per_ns, op_memory.c_str());
+    }
+
+    return fresh_begin + fresh_keys;
+}
+
+using DigestNodeIDBucketedMap = BucketedDigestMap<NodeID>;
+
+template<class Map>
+void bucketed_fill_until(Map bucketed_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int fill_size) {
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(0, fill_size);
+    Kokkos::parallel_for("bucketed_fill", policy, KOKKOS_LAMBDA(const int i) {
+        bucketed_hash.insert(sample_digests(i), NodeID(sample_data(i), 1));
+    });
+    Kokkos::fence();
+}
+
+template<class Map>
+void bucketed_insertion_test(Map bucketed_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+        if(starting_index + num_insertions > capacity - 1)
+            num_insertions = capacity - starting_index - 1;
+    }
+
+    std::string label = "Bucketed Insertion Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    Kokkos::Timer timer;
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(starting_index, starting_index + num_insertions);
+    Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i) {
+        bucketed_hash.insert(sample_digests(i), NodeID(sample_data(i), 1));
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(bucketed_hash.footprint(), bucketed_hash.size(), (double)num_insertions * bucketed_insert_bytes<Map>(), time);
+
+    printf("BI C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+//KeysPerTeam keys per team, spread over its threads, each thread probes with BucketSize vector lanes
+template<class Map, int KeysPerTeam = 64>
+void bucketed_team_insertion_test(Map bucketed_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_insertions, int capacity, int percent_full) {
+    if(num_insertions < 5120) {
+        num_insertions = 5120;
+        if(starting_index + num_insertions > capacity - 1)
+            num_insertions = capacity - starting_index - 1;
+    }
+
+    std::string label = "Bucketed Team Insertion Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    using team_policy = Kokkos::TeamPolicy<typename Map::execution_space>;
+    int end = starting_index + num_insertions;
+    int league_size = (num_insertions + KeysPerTeam - 1) / KeysPerTeam;
+
+    Kokkos::Timer timer;
+    Kokkos::parallel_for(label, team_policy(league_size, Kokkos::AUTO, Map::bucket_size), KOKKOS_LAMBDA(const typename team_policy::member_type& member) {
+        int team_start = starting_index + member.league_rank() * KeysPerTeam;
+        int team_end = team_start + KeysPerTeam < end ? team_start + KeysPerTeam : end;
+        Kokkos::parallel_for(Kokkos::TeamThreadRange(member, team_start, team_end), [&](const int i) {
+            bucketed_hash.insert(member, sample_digests(i), NodeID(sample_data(i), 1));
+        });
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(bucketed_hash.footprint(), bucketed_hash.size(), (double)num_insertions * bucketed_insert_bytes<Map>(), time);
+
+    printf("BIT C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_insertions, memory.c_str());
+}
+
+template<class Map>
+void bucketed_find_test(Map bucketed_hash, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_finds, int capacity, int percent_full) {
+    if(num_finds < 5120) {
+        num_finds = 5120;
+        if(starting_index + num_finds > capacity - 1)
+            num_finds = capacity - starting_index - 1;
+    }
+
+    std::string label = "Bucketed Find Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    Kokkos::Timer timer;
+    auto policy = Kokkos::RangePolicy<typename Map::execution_space>(starting_index, starting_index + num_finds);
+    Kokkos::parallel_for(label, policy, KOKKOS_LAMBDA(const int i) {
+        bucketed_hash.find(sample_digests(i));
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(bucketed_hash.footprint(), bucketed_hash.size(), (double)num_finds * bucketed_find_bytes<Map>(), time);
+
+    printf("BF C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_finds, memory.c_str());
+}
+
+//Same team layout as bucketed_team_insertion_test
+template<class Map, int KeysPerTeam = 64>
+void bucketed_team_find_test(Map bucketed_hash, Kokkos::View<HashDigest*> sample_digests, int starting_index, int num_finds, int capacity, int percent_full) {
+    if(num_finds < 5120) {
+        num_finds = 5120;
+        if(starting_index + num_finds > capacity - 1)
+            num_finds = capacity - starting_index - 1;
+    }
+
+    std::string label = "Bucketed Team Find Test -- Capacity = " + std::to_string(capacity)
+    + " -- Percent Full = " + std::to_string(percent_full) + "%";
+
+    using team_policy = Kokkos::TeamPolicy<typename Map::execution_space>;
+    int end = starting_index + num_finds;
+    int league_size = (num_finds + KeysPerTeam - 1) / KeysPerTeam;
+
+    Kokkos::Timer timer;
+    Kokkos::parallel_for(label, team_policy(league_size, Kokkos::AUTO, Map::bucket_size), KOKKOS_LAMBDA(const typename team_policy::member_type& member) {
+        int team_start = starting_index + member.league_rank() * KeysPerTeam;
+        int team_end = team_start + KeysPerTeam < end ? team_start + KeysPerTeam : end;
+        Kokkos::parallel_for(Kokkos::TeamThreadRange(member, team_start, team_end), [&](const int i) {
+            bucketed_hash.find(member, sample_digests(i));
+        });
+    });
+    Kokkos::fence();
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(bucketed_hash.footprint(), bucketed_hash.size(), (double)num_finds * bucketed_find_bytes<Map>(), time);
+
+    printf("BFT C %d F %d T %lf I %d %s\n", capacity, percent_full, time, num_finds, memory.c_str());
+}
+
+//Hashes sample_data[start, start + count) into digests[0, count)
+void hash_batch(const Kokkos::DefaultExecutionSpace& space, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> digests, int start, int count) {
+    auto policy = Kokkos::RangePolicy<>(space, 0, count);
+    Kokkos::parallel_for("ingest_hash", policy, KOKKOS_LAMBDA(const int i) {
+        HashDigest digest;
+        hash(&(sample_data(start + i)), sizeof(uint32_t), digest.digest);
+        digests(i) = digest;
+    });
+}
+
+void insert_batch(const Kokkos::DefaultExecutionSpace& space, DigestNodeIDDeviceMap device_hash, Kokkos::View<uint32_t*> sample_data, Kokkos::View<HashDigest*> digests, int start, int count) {
+    auto policy = Kokkos::RangePolicy<>(space, 0, count);
+    Kokkos::parallel_for("ingest_insert", policy, KOKKOS_LAMBDA(const int i) {
+        device_hash.insert(digests(i), NodeID(sample_data(start + i), 1));
+    });
+}
+
+//Hashing reads the input word and writes the digest, then the digest is inserted
+const size_t ingest_bytes = sizeof(uint32_t) + sizeof(HashDigest) + insert_bytes<DigestNodeIDDeviceMap>();
+
+//Hash then insert each batch, all cores on one stage at a time
+void sequential_ingest_test(Kokkos::View<uint32_t*> sample_data, int batch_size, int capacity) {
+    int total = (9 * capacity) / 10;
+    DigestNodeIDDeviceMap device_hash(capacity);
+    Kokkos::View<HashDigest*> digests("ingest_digests", batch_size);
+    Kokkos::DefaultExecutionSpace space;
+
+    Kokkos::Timer timer;
+    for(int start = 0; start < total; start += batch_size) {
+        int count = start + batch_size < total ? batch_size : total - start;
+        hash_batch(space, sample_data, digests, start, count);
+        Kokkos::fence();
+        insert_batch(space, device_hash, sample_data, digests, start, count);
+        Kokkos::fence();
+    }
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)total * ingest_bytes, time);
+
+    printf("IS C %d F 90 T %lf I %d B %d M %lf %s\n", capacity, time, total, batch_size, total / time / 1e6, memory.c_str());
+}
+
+/* Hashing of batch k+1 on one partition overlaps insertion of batch k on the
+   other. Host backends run a kernel synchronously on the thread that submits
+   it, so each stage is driven by a host thread of its own (for_each_concurrent_host_thread)
+   and they hand batches over through the two digest buffers: the hash stage
+   waits until the insert of batch k-1 has released buffer (k+1)%2, the insert
+   stage waits until batch k is hashed. */
+void pipelined_ingest_test(Kokkos::View<uint32_t*> sample_data, int batch_size, int capacity) {
+    int total = (9 * capacity) / 10;
+    int num_batches = (total + batch_size - 1) / batch_size;
+    DigestNodeIDDeviceMap device_hash(capacity);
+    Kokkos::View<HashDigest*> digests[2] = {Kokkos::View<HashDigest*>("ingest_digests_0", batch_size),
+                                            Kokkos::View<HashDigest*>("ingest_digests_1", batch_size)};
+    auto instances = Kokkos::Experimental::partition_space(Kokkos::DefaultExecutionSpace(), 1, 1);
+    auto& hash_space = instances[0];
+    auto& insert_space = instances[1];
+
+    std::mutex handoff_mutex;
+    std::condition_variable handoff;
+    int hashed = 0;
+    int inserted = 0;
+
+    Kokkos::Timer timer;
+    for_each_concurrent_host_thread(2, [&](uint32_t stage) {
+        for(int k = 0; k < num_batches; ++k) {
+            int start = k * batch_size;
+            int count = start + batch_size < total ? batch_size : total - start;
+            std::unique_lock<std::mutex> lock(handoff_mutex);
+            if(stage == 0) {
+                handoff.wait(lock, [&]() { return k - inserted < 2; });
+                lock.unlock();
+                hash_batch(hash_space, sample_data, digests[k % 2], start, count);
+                hash_space.fence();
+                lock.lock();
+                hashed = k + 1;
+            } else {
+                handoff.wait(lock, [&]() { return hashed > k; });
+                lock.unlock();
+                insert_batch(insert_space, device_hash, sample_data, digests[k % 2], start, count);
+                insert_space.fence();
+                lock.lock();
+                inserted = k + 1;
+            }
+            handoff.notify_all();
+        }
+    });
+    double time = timer.seconds();
+
+    std::string memory = memory_fields(map_footprint(device_hash), device_hash.size(), (double)total * ingest_bytes, time);
+
+    printf("IP C %d F 90 T %lf I %d B %d M %lf %s\n", capacity, time, total, batch_size, total / time / 1e6, memory.c_str());
 }
 
 int main(int argc, char** argv) {
     Kokkos::initialize(argc, argv);
     {   
-        if(argc != 2) {
-            printf("Usage: %s <capacity_multiplyer>\n", argv[0]);
+        if(argc != 2 && argc != 3) {
+            printf("Usage: %s <capacity_multiplyer> [num_shards]\n", argv[0]);
             Kokkos::finalize();
             exit(1);
         }
 
         int capacity_multiplier = atoi(argv[1]);
+        //One shard per socket on our dual-socket nodes, every shard needs at least one host thread
+        int concurrency = Kokkos::DefaultHostExecutionSpace().concurrency();
+        int num_shards = concurrency < 2 ? concurrency : 2;
+        if(argc == 3) {
+            char* end = nullptr;
+            long requested = strtol(argv[2], &end, 10);
+            if(end == argv[2] || *end != '\0' || requested < 1 || requested > concurrency) {
+                printf("Usage: %s <capacity_multiplyer> [num_shards]\n", argv[0]);
+                printf("num_shards must be between 1 and %d\n", concurrency);
+                Kokkos::finalize();
+                exit(1);
+            }
+            num_shards = (int)requested;
+        }
         // int capacity = 10000;
         int capacity = 80000;
         // Kokkos::View<uint32_t*> sample_data("sample_data", capacity * pow(2, 15));
@@ -220,12 +914,28 @@ int main(int argc, char** argv) {
         Kokkos::View<HashDigest*> sample_digests("sample_digests", capacity * pow(2, capacity_multiplier));
 
         create_sample_data(sample_data,sample_digests);
+        Kokkos::View<NodeID*> sample_values("sample_values", sample_data.extent(0));
+        fill_values(sample_data, sample_values);
+        auto host_digests = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), sample_digests);
+        auto host_values = Kokkos::create_mirror_view_and_copy(Kokkos::HostSpace(), sample_values);
 
   
         for(int i = 0; i < capacity_multiplier; ++i) {
             //Create a new hash
             DigestNodeIDDeviceMap device_hash;
+            Kokkos::Timer rehash_timer;
             device_hash.rehash(capacity);
+            Kokkos::fence();
+            double rehash_time = rehash_timer.seconds();
+            //rehash allocates and initializes every array of the table
+            MapFootprint footprint = map_footprint(device_hash);
+            printf("RH C %d F 0 T %lf I 0 %s\n", capacity, rehash_time, memory_fields(footprint, 0, footprint.total(), rehash_time).c_str());
+            DigestIdxDeviceMap count_hash;
+            count_hash.rehash(capacity);
+            ShardedDigestMap<NodeID> sharded_hash(capacity, num_shards);
+            //Separate tables so the flat and team inserts both start from the same fill
+            DigestNodeIDBucketedMap bucketed_hash(capacity);
+            DigestNodeIDBucketedMap bucketed_team_hash(capacity);
 
 
             //Test for different initial fills
@@ -236,14 +946,63 @@ int main(int argc, char** argv) {
                 int fill_size = (percent_full * capacity) / 100;
 
                 fill_until(device_hash, sample_data, sample_digests, fill_size);
-                insertion_test(device_hash, sample_data, sample_digests, fill_size, num_insertions, capacity, percent_full);
-                find_test(device_hash, sample_data, sample_digests,  fill_size, num_insertions, capacity, percent_full);
-                single_rep_insert_test(device_hash, sample_data, sample_digests, 0, num_insertions, capacity, percent_full);
-                multiple_rep_insert_test(device_hash, sample_data, sample_digests, num_insertions, capacity, percent_full);
+                insertion_test(device_hash, sample_data, sample_digests, fill_size, num_insertions, capacity, percent_full, "DigestNodeIDDeviceMap");
+                find_test(device_hash, sample_data, sample_digests,  fill_size, num_insertions, capacity, percent_full, "DigestNodeIDDeviceMap");
+                single_rep_insert_test(device_hash, sample_data, sample_digests, 0, num_insertions, capacity, percent_full, "DigestNodeIDDeviceMap");
+                multiple_rep_insert_test(device_hash, sample_data, sample_digests, num_insertions, capacity, percent_full, "DigestNodeIDDeviceMap");
+
+                //Back to back on the same map, each mix sees what the previous one left behind.
+                //fill_until and insertion_test stored a contiguous prefix of the keys (SI/MI only touch keys below 100),
+                //so the map size is the end of the live range. Each mix gets its own fresh keys and a third of the free slots.
+                WorkloadMix mixes[3] = {{95, 5, 0}, {50, 50, 0}, {80, 15, 5}};
+                int live_keys = device_hash.size();
+                int fresh_begin = live_keys;
+                int max_fresh = ((int)device_hash.capacity() - live_keys) / 3;
+                for(WorkloadMix mix : mixes)
+                    fresh_begin = mixed_workload_test(device_hash, sample_digests, mix, live_keys, fresh_begin, max_fresh, 100 * num_insertions, capacity, percent_full);
+
+                sharded_hash.insert(host_digests, host_values, 0, fill_size);
+                sharded_insertion_test(sharded_hash, host_digests, host_values, fill_size, num_insertions, capacity, percent_full);
+                sharded_find_test(sharded_hash, host_digests, fill_size, num_insertions, capacity, percent_full);
+
+                bucketed_fill_until(bucketed_hash, sample_data, sample_digests, fill_size);
+                bucketed_fill_until(bucketed_team_hash, sample_data, sample_digests, fill_size);
+                bucketed_insertion_test(bucketed_hash, sample_data, sample_digests, fill_size, num_insertions, capacity, percent_full);
+                bucketed_team_insertion_test(bucketed_team_hash, sample_data, sample_digests, fill_size, num_insertions, capacity, percent_full);
+                bucketed_find_test(bucketed_hash, sample_digests, fill_size, num_insertions, capacity, percent_full);
+                bucketed_team_find_test(bucketed_team_hash, sample_digests, fill_size, num_insertions, capacity, percent_full);
+
+                fill_counts_until(count_hash, sample_digests, fill_size);
+                single_rep_upsert_test(count_hash, sample_digests, 0, num_insertions, capacity, percent_full);
+                single_rep_two_step_test(count_hash, sample_digests, 0, num_insertions, capacity, percent_full);
+                multiple_rep_upsert_test(count_hash, sample_digests, num_insertions, capacity, percent_full);
+                multiple_rep_two_step_test(count_hash, sample_digests, num_insertions, capacity, percent_full);
 
                 device_hash.clear();
+                count_hash.clear();
+                sharded_hash.clear();
+                bucketed_hash.clear();
+                bucketed_team_hash.clear();
             }
 
+            //Remaining key/value combinations from map_helpers.hpp
+            key_type_sweep<DigestIdxDeviceMap>(sample_data, DigestKeyGen(), 7000, capacity, "DigestIdxDeviceMap");
+            key_type_sweep<IdxNodeIDDeviceMap>(sample_data, IdxKeyGen(), 7000, capacity, "IdxNodeIDDeviceMap");
+            key_type_sweep<IdxNodeIDFmixDeviceMap>(sample_data, IdxKeyGen(), 7000, capacity, "IdxNodeIDFmixDeviceMap");
+            key_type_sweep<IdxNodeIDIdentityDeviceMap>(sample_data, IdxKeyGen(), 7000, capacity, "IdxNodeIDIdentityDeviceMap");
+            key_type_sweep<IdxIdxFmixDeviceMap>(sample_data, IdxKeyGen(), 7000, capacity, "IdxIdxFmixDeviceMap");
+            host_key_type_sweep<DigestNodeIDHostMap, DigestNodeIDDeviceMap>(sample_data, DigestKeyGen(), 7000, capacity, "DigestNodeIDHostMap");
+            host_key_type_sweep<DigestIdxHostMap, DigestIdxDeviceMap>(sample_data, DigestKeyGen(), 7000, capacity, "DigestIdxHostMap");
+            host_key_type_sweep<IdxNodeIDHostMap, IdxNodeIDDeviceMap>(sample_data, IdxKeyGen(), 7000, capacity, "IdxNodeIDHostMap");
+
+            sequential_ingest_test(sample_data, 65536, capacity);
+            pipelined_ingest_test(sample_data, 65536, capacity);
+
+            thread_scaling_test(host_digests, host_values, 7000, capacity, num_shards);
+
+            growable_insertion_test(sample_digests, sample_values, 7000, capacity);
+            rehash_insertion_test(sample_digests, sample_values, 7000, capacity);
+
             capacity *= 2;
         }
     }